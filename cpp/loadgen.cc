@@ -0,0 +1,540 @@
+// Native epoll-based load generator for the ping-pong benchmark.
+//
+// Drives the server with N concurrent keep-alive connections, optionally
+// pipelining several requests per connection, and prints the same report
+// format as client/main.py so runs can be diffed against the recorded
+// *-stats.txt files. Configured via environment variables:
+//
+//   LOADGEN_URL          target (default http://localhost:8000/ping)
+//   LOADGEN_CONNECTIONS  concurrent connections     (default 125)
+//   LOADGEN_REQUESTS     total requests to issue    (default 100000)
+//   LOADGEN_PIPELINE     requests in flight per conn (default 1)
+//   LOADGEN_DURATION     seconds; when > 0 runs time-bounded instead of
+//                        request-bounded
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const char *envString(const char *name, const char *fallback) {
+  const char *value = getenv(name);
+  return (value && *value) ? value : fallback;
+}
+
+static int envInt(const char *name, int fallback) {
+  const char *value = getenv(name);
+  if (!value || !*value)
+    return fallback;
+  return atoi(value);
+}
+
+// "100000" -> "100,000", matching Python's {:,} formatting.
+static std::string formatThousands(uint64_t value) {
+  std::string digits = std::to_string(value);
+  std::string out;
+  int count = 0;
+  for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+    if (count && count % 3 == 0)
+      out.insert(out.begin(), ',');
+    out.insert(out.begin(), *it);
+    ++count;
+  }
+  return out;
+}
+
+struct Target {
+  std::string host = "localhost";
+  int port = 8000;
+  std::string path = "/ping";
+  std::string url;
+};
+
+// Minimal http:// URL splitter - enough for the benchmark targets.
+static bool parseUrl(const std::string &url, Target &target) {
+  target.url = url;
+  std::string rest = url;
+  if (rest.rfind("http://", 0) == 0)
+    rest = rest.substr(7);
+  size_t slash = rest.find('/');
+  std::string hostport = rest.substr(0, slash);
+  target.path = (slash == std::string::npos) ? "/" : rest.substr(slash);
+  size_t colon = hostport.find(':');
+  if (colon == std::string::npos) {
+    target.host = hostport;
+  } else {
+    target.host = hostport.substr(0, colon);
+    target.port = atoi(hostport.c_str() + colon + 1);
+  }
+  return !target.host.empty() && target.port > 0;
+}
+
+static int connectBlocking(const Target &target) {
+  struct addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result = nullptr;
+  if (getaddrinfo(target.host.c_str(), std::to_string(target.port).c_str(),
+                  &hints, &result) != 0)
+    return -1;
+  int fd = socket(result->ai_family, result->ai_socktype, 0);
+  if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+  if (fd >= 0) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  }
+  return fd;
+}
+
+// One blocking request/response round trip; used by the reachability
+// check and the warmup phase. Returns true on a 2xx status line.
+static bool blockingRequest(int fd, const std::string &request) {
+  if (send(fd, request.data(), request.size(), 0) !=
+      static_cast<ssize_t>(request.size()))
+    return false;
+  char buffer[8192];
+  ssize_t bytes = recv(fd, buffer, sizeof(buffer) - 1, 0);
+  return bytes > 12 && memcmp(buffer, "HTTP/1.1 2", 10) == 0;
+}
+
+// Tracks totals and per-request latencies, then prints the same results
+// block client/main.py emits.
+struct BenchmarkStats {
+  uint64_t successful = 0;
+  uint64_t failed = 0;
+  std::vector<double> latencies_ms;
+  double total_seconds = 0;
+
+  double percentile(double fraction) const {
+    if (latencies_ms.empty())
+      return 0;
+    size_t index = static_cast<size_t>(latencies_ms.size() * fraction);
+    if (index >= latencies_ms.size())
+      index = latencies_ms.size() - 1;
+    return latencies_ms[index];
+  }
+
+  void report() {
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    uint64_t total = successful + failed;
+    double rps = total_seconds > 0 ? successful / total_seconds : 0;
+    double sum = 0;
+    for (double v : latencies_ms)
+      sum += v;
+    double avg = latencies_ms.empty() ? 0 : sum / latencies_ms.size();
+
+    std::string bar(70, '=');
+    printf("\n%s\n", bar.c_str());
+    printf("📈 BENCHMARK RESULTS\n");
+    printf("%s\n", bar.c_str());
+    printf("🎯 Total Requests:     %s\n", formatThousands(total).c_str());
+    printf("✅ Successful:         %s\n", formatThousands(successful).c_str());
+    printf("❌ Failed:             %s\n", formatThousands(failed).c_str());
+    printf("⏱️  Total Time:         %.2f seconds\n", total_seconds);
+    printf("🚀 Requests/Second:    %.2f\n", rps);
+    printf("\n📊 Response Times (milliseconds):\n");
+    printf("   Average:     %.2f ms\n", avg);
+    printf("   Minimum:     %.2f ms\n",
+           latencies_ms.empty() ? 0 : latencies_ms.front());
+    printf("   Maximum:     %.2f ms\n",
+           latencies_ms.empty() ? 0 : latencies_ms.back());
+    printf("   50th %%ile:   %.2f ms\n", percentile(0.50));
+    printf("   95th %%ile:   %.2f ms\n", percentile(0.95));
+    printf("   99th %%ile:   %.2f ms\n", percentile(0.99));
+
+    const char *rating = "⚠️  NEEDS IMPROVEMENT";
+    if (rps > 10000)
+      rating = "🔥 EXCELLENT";
+    else if (rps > 5000)
+      rating = "⚡ VERY GOOD";
+    else if (rps > 1000)
+      rating = "✨ GOOD";
+    else if (rps > 500)
+      rating = "👍 FAIR";
+    printf("\n🏆 Performance Rating: %s\n", rating);
+    printf("%s\n", bar.c_str());
+  }
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Per-connection state for the epoll loop. Requests are pipelined up to
+// the configured depth; send timestamps queue up FIFO and are matched to
+// responses as they complete.
+struct LoadConnection {
+  int fd = -1;
+  std::deque<Clock::time_point> in_flight;
+  std::string pending_out;     // unsent request bytes (partial write)
+  std::string read_buffer;     // partial response bytes
+  long body_remaining = -1;    // body bytes still owed; -1 = in headers
+  bool connecting = false;
+};
+
+class LoadGenerator {
+private:
+  Target target;
+  int connection_count;
+  uint64_t total_requests;
+  int pipeline_depth;
+  int duration_seconds;
+  std::string request_bytes;
+
+  int epoll_fd = -1;
+  std::vector<LoadConnection> connections; // indexed by fd
+  uint64_t sent = 0;
+  Clock::time_point started;
+  Clock::time_point deadline;
+  int next_progress_step = 1; // next 5% milestone to announce
+  BenchmarkStats stats;
+
+  bool durationMode() const { return duration_seconds > 0; }
+
+  bool done() const {
+    if (durationMode())
+      return Clock::now() >= deadline;
+    return stats.successful + stats.failed >= total_requests;
+  }
+
+  void setInterest(int fd, uint32_t events) {
+    struct epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+  }
+
+  bool openConnection() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+      return false;
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(target.port);
+    struct addrinfo hints{}, *result = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(target.host.c_str(), nullptr, &hints, &result) != 0) {
+      close(fd);
+      return false;
+    }
+    addr.sin_addr = reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+
+    int rc = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    if (rc != 0 && errno != EINPROGRESS) {
+      close(fd);
+      return false;
+    }
+
+    if (static_cast<size_t>(fd) >= connections.size())
+      connections.resize(fd + 64);
+    LoadConnection &conn = connections[fd];
+    conn = LoadConnection{};
+    conn.fd = fd;
+    conn.connecting = (rc != 0);
+
+    struct epoll_event event{};
+    event.events = conn.connecting ? EPOLLOUT : (EPOLLIN | EPOLLOUT);
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    if (!conn.connecting)
+      fillPipeline(conn);
+    return true;
+  }
+
+  void closeConnection(LoadConnection &conn, bool count_failures) {
+    if (conn.fd < 0)
+      return;
+    if (count_failures)
+      stats.failed += conn.in_flight.size();
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    close(conn.fd);
+    conn.fd = -1;
+    // Keep the connection count up while there is still work to issue.
+    if (!done())
+      openConnection();
+  }
+
+  bool mayIssue() const {
+    if (durationMode())
+      return Clock::now() < deadline;
+    return sent < total_requests;
+  }
+
+  // Queue requests until this connection is at pipeline depth, then
+  // flush as much as the socket accepts in one write.
+  void fillPipeline(LoadConnection &conn) {
+    while (static_cast<int>(conn.in_flight.size()) < pipeline_depth &&
+           mayIssue()) {
+      conn.pending_out += request_bytes;
+      conn.in_flight.push_back(Clock::now());
+      ++sent;
+    }
+    flushPending(conn);
+  }
+
+  void flushPending(LoadConnection &conn) {
+    while (!conn.pending_out.empty()) {
+      ssize_t written = send(conn.fd, conn.pending_out.data(),
+                             conn.pending_out.size(), MSG_NOSIGNAL);
+      if (written > 0) {
+        conn.pending_out.erase(0, written);
+        continue;
+      }
+      if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        setInterest(conn.fd, EPOLLIN | EPOLLOUT);
+        return;
+      }
+      closeConnection(conn, true);
+      return;
+    }
+    setInterest(conn.fd, EPOLLIN);
+  }
+
+  void completeResponse(LoadConnection &conn, bool success) {
+    Clock::time_point sent_at;
+    if (!conn.in_flight.empty()) {
+      sent_at = conn.in_flight.front();
+      conn.in_flight.pop_front();
+    }
+    if (success) {
+      ++stats.successful;
+      double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                            sent_at)
+                      .count();
+      stats.latencies_ms.push_back(ms);
+    } else {
+      ++stats.failed;
+    }
+    reportProgress();
+  }
+
+  // Incremental response consumer: find the header terminator, read the
+  // advertised Content-Length, swallow the body, repeat for pipelined
+  // responses sharing one read.
+  void consumeResponses(LoadConnection &conn) {
+    for (;;) {
+      if (conn.body_remaining >= 0) {
+        long take = std::min<long>(conn.body_remaining,
+                                   static_cast<long>(conn.read_buffer.size()));
+        conn.read_buffer.erase(0, take);
+        conn.body_remaining -= take;
+        if (conn.body_remaining > 0)
+          return; // need more body bytes
+        conn.body_remaining = -1;
+        completeResponse(conn, true);
+        continue;
+      }
+      size_t header_end = conn.read_buffer.find("\r\n\r\n");
+      if (header_end == std::string::npos)
+        return;
+      bool ok = conn.read_buffer.compare(0, 10, "HTTP/1.1 2") == 0;
+      long content_length = 0;
+      size_t cl = conn.read_buffer.find("Content-Length:");
+      if (cl != std::string::npos && cl < header_end)
+        content_length = atol(conn.read_buffer.c_str() + cl + 15);
+      conn.read_buffer.erase(0, header_end + 4);
+      if (!ok) {
+        completeResponse(conn, false);
+        closeConnection(conn, true);
+        return;
+      }
+      conn.body_remaining = content_length;
+    }
+  }
+
+  void handleReadable(LoadConnection &conn) {
+    char buffer[16384];
+    for (;;) {
+      ssize_t bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+      if (bytes > 0) {
+        conn.read_buffer.append(buffer, bytes);
+        consumeResponses(conn);
+        if (conn.fd < 0)
+          return;
+        if (bytes < static_cast<ssize_t>(sizeof(buffer)))
+          break;
+        continue;
+      }
+      if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      closeConnection(conn, true);
+      return;
+    }
+    if (conn.in_flight.empty() && !mayIssue()) {
+      closeConnection(conn, false);
+      return;
+    }
+    fillPipeline(conn);
+  }
+
+  void reportProgress() {
+    uint64_t completed = stats.successful + stats.failed;
+    if (durationMode()) {
+      double elapsed =
+          std::chrono::duration<double>(Clock::now() - started).count();
+      while (elapsed >= duration_seconds * 0.05 * next_progress_step &&
+             next_progress_step <= 20) {
+        printf("Progress: %.1f%% (%s requests)\n", next_progress_step * 5.0,
+               formatThousands(completed).c_str());
+        ++next_progress_step;
+      }
+      return;
+    }
+    while (completed * 20 >= total_requests * next_progress_step &&
+           next_progress_step <= 20) {
+      printf("Progress: %.1f%% (%s/%s)\n", next_progress_step * 5.0,
+             formatThousands(total_requests * next_progress_step / 20).c_str(),
+             formatThousands(total_requests).c_str());
+      ++next_progress_step;
+    }
+  }
+
+public:
+  LoadGenerator(const Target &target, int connections, uint64_t requests,
+                int pipeline, int duration)
+      : target(target), connection_count(connections),
+        total_requests(requests), pipeline_depth(std::max(1, pipeline)),
+        duration_seconds(duration) {
+    request_bytes = "GET " + target.path + " HTTP/1.1\r\nHost: " +
+                    target.host + "\r\nConnection: keep-alive\r\n\r\n";
+  }
+
+  bool run() {
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0)
+      return false;
+
+    started = Clock::now();
+    deadline = started + std::chrono::seconds(duration_seconds);
+    if (!durationMode())
+      stats.latencies_ms.reserve(total_requests);
+
+    for (int i = 0; i < connection_count; ++i)
+      openConnection();
+
+    struct epoll_event events[256];
+    while (!done()) {
+      int ready = epoll_wait(epoll_fd, events, 256, 100);
+      for (int i = 0; i < ready; ++i) {
+        int fd = events[i].data.fd;
+        LoadConnection &conn = connections[fd];
+        if (conn.fd != fd)
+          continue; // closed earlier this tick
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          closeConnection(conn, true);
+          continue;
+        }
+        if (conn.connecting) {
+          int error = 0;
+          socklen_t len = sizeof(error);
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+          if (error != 0) {
+            closeConnection(conn, true);
+            continue;
+          }
+          conn.connecting = false;
+          fillPipeline(conn);
+          continue;
+        }
+        if (events[i].events & EPOLLOUT)
+          flushPending(conn);
+        if (conn.fd == fd && (events[i].events & EPOLLIN))
+          handleReadable(conn);
+      }
+    }
+
+    stats.total_seconds =
+        std::chrono::duration<double>(Clock::now() - started).count();
+    for (auto &conn : connections) {
+      if (conn.fd >= 0) {
+        int fd = conn.fd;
+        // Requests still in flight at exit were never answered: count
+        // them as failures like any other abandoned connection, the way
+        // client/main.py counts its timeouts - otherwise a starved run
+        // reports Failed: 0 with percentiles drawn only from the
+        // connections the server deigned to serve.
+        stats.failed += conn.in_flight.size();
+        conn.fd = -1;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+      }
+    }
+    close(epoll_fd);
+    stats.report();
+    return true;
+  }
+};
+
+int main() {
+  Target target;
+  if (!parseUrl(envString("LOADGEN_URL", "http://localhost:8000/ping"),
+                target)) {
+    std::cerr << "❌ Invalid LOADGEN_URL\n";
+    return 1;
+  }
+  int connections = envInt("LOADGEN_CONNECTIONS", 125);
+  uint64_t requests = static_cast<uint64_t>(envInt("LOADGEN_REQUESTS", 100000));
+  int pipeline = envInt("LOADGEN_PIPELINE", 1);
+  int duration = envInt("LOADGEN_DURATION", 0);
+
+  std::string request = "GET " + target.path + " HTTP/1.1\r\nHost: " +
+                        target.host + "\r\nConnection: keep-alive\r\n\r\n";
+
+  // Reachability check, mirroring the Python client's preamble.
+  int probe = connectBlocking(target);
+  if (probe < 0 || !blockingRequest(probe, request)) {
+    std::cerr << "❌ Server is not responding at " << target.url << "\n";
+    if (probe >= 0)
+      close(probe);
+    return 1;
+  }
+  printf("✅ Server is responding at %s\n", target.url.c_str());
+
+  printf("🔥 Warming up server with 100 requests...\n");
+  for (int i = 0; i < 100; ++i) {
+    if (!blockingRequest(probe, request))
+      break;
+  }
+  close(probe);
+  printf("✅ Warmup complete!\n");
+
+  printf("🚀 Starting optimized HTTP benchmark\n");
+  printf("📊 Configuration:\n");
+  printf("   - Target URL: %s\n", target.url.c_str());
+  if (duration > 0)
+    printf("   - Duration: %d seconds\n", duration);
+  else
+    printf("   - Total requests: %s\n", formatThousands(requests).c_str());
+  printf("   - Concurrent requests: %s\n",
+         formatThousands(static_cast<uint64_t>(connections) * pipeline)
+             .c_str());
+  printf("   - Connection pool size: %d\n", connections);
+  if (pipeline > 1)
+    printf("   - Pipeline depth: %d\n", pipeline);
+  printf("%s\n", std::string(70, '=').c_str());
+
+  LoadGenerator generator(target, connections, requests, pipeline, duration);
+  return generator.run() ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+// Micro-benchmark harness for the server's hot-path primitives.
+//
+// Exercises the real implementations - not copies - by compiling main.cc
+// into this binary with its entry point renamed, then timing each
+// primitive in isolation: request scanning and routing on captured
+// request bytes, timestamp formatting (slow path and seqlock cache),
+// MPMC ring enqueue/dequeue at varying thread counts, and full
+// ThreadPool dispatch round trips. One CSV row per benchmark goes to
+// stdout so per-commit numbers can be tracked alongside the
+// client/*-stats.txt comparisons; progress chatter goes to stderr.
+// Configured via environment variables:
+//
+//   MICROBENCH_SECONDS  target wall time per benchmark (default 1)
+//   MICROBENCH_THREADS  producer/consumer pair counts for the ring
+//                       benchmarks, comma-separated (default 1,2,4)
+
+#define main server_main // the server's entry point, not ours
+#include "main.cc"
+#undef main
+
+#include <sstream>
+
+namespace Microbench {
+
+// Keep a computed value alive without a store the optimizer can sink.
+template <typename T> static inline void keep(T &value) {
+  asm volatile("" : "+r"(value));
+}
+
+static uint64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// One result row. bytes_per_op > 0 adds a throughput column (MB/s).
+static void report(const char *name, int threads, uint64_t iterations,
+                   uint64_t elapsed_ns, size_t bytes_per_op) {
+  double ns_per_op =
+      iterations ? static_cast<double>(elapsed_ns) / iterations : 0.0;
+  double ops_per_sec =
+      elapsed_ns ? iterations * 1e9 / static_cast<double>(elapsed_ns) : 0.0;
+  double mb_per_sec =
+      bytes_per_op ? ops_per_sec * bytes_per_op / (1024.0 * 1024.0) : 0.0;
+  printf("%s,%d,%llu,%.1f,%.0f,%.1f\n", name, threads,
+         static_cast<unsigned long long>(iterations), ns_per_op, ops_per_sec,
+         mb_per_sec);
+  fprintf(stderr, "  %-24s %8.1f ns/op %14.0f ops/s\n", name, ns_per_op,
+          ops_per_sec);
+}
+
+// Run `body(batch)` in batches until the target wall time has elapsed.
+// Returns total iterations and the measured nanoseconds.
+template <typename Body>
+static std::pair<uint64_t, uint64_t> runTimed(uint64_t target_ns,
+                                              Body &&body) {
+  constexpr uint64_t BATCH = 4096;
+  uint64_t iterations = 0;
+  uint64_t start = nowNanos();
+  uint64_t elapsed = 0;
+  while (elapsed < target_ns) {
+    body(BATCH);
+    iterations += BATCH;
+    elapsed = nowNanos() - start;
+  }
+  return {iterations, elapsed};
+}
+
+// Captured request bytes, byte-for-byte what the load paths see: the
+// minimal keep-alive request loadgen pipelines, and a browser-style
+// request with the headers the scanner actually extracts.
+static constexpr const char PING_REQUEST[] =
+    "GET /ping HTTP/1.1\r\n"
+    "Host: localhost:8000\r\n"
+    "\r\n";
+
+static constexpr const char BROWSER_REQUEST[] =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost:8000\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101\r\n"
+    "Accept: text/html,application/json;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+static void benchScan(const char *name, const char *request, size_t len,
+                      uint64_t target_ns) {
+  auto [iterations, elapsed] = runTimed(target_ns, [&](uint64_t batch) {
+    for (uint64_t i = 0; i < batch; ++i) {
+      HttpScanner::RequestView view;
+      bool ok = HttpScanner::scan(request, len, view);
+      int route =
+          static_cast<int>(Router::matchPath(view.path, view.path_len));
+      route += ok;
+      keep(route);
+    }
+  });
+  report(name, 1, iterations, elapsed, len);
+}
+
+static void benchTimestampFormat(uint64_t target_ns) {
+  auto [iterations, elapsed] = runTimed(target_ns, [&](uint64_t batch) {
+    for (uint64_t i = 0; i < batch; ++i) {
+      char buffer[32];
+      TimestampCache::formatNow(buffer, sizeof(buffer));
+      int sink = buffer[0];
+      keep(sink);
+    }
+  });
+  report("timestamp_format", 1, iterations, elapsed, 0);
+}
+
+static void benchTimestampCached(uint64_t target_ns) {
+  TimestampCache cache;
+  cache.start();
+  auto [iterations, elapsed] = runTimed(target_ns, [&](uint64_t batch) {
+    for (uint64_t i = 0; i < batch; ++i) {
+      char buffer[32];
+      cache.read(buffer, sizeof(buffer));
+      int sink = buffer[0];
+      keep(sink);
+    }
+  });
+  report("timestamp_cached_read", 1, iterations, elapsed, 0);
+}
+
+// Single-threaded ring round trip: one push immediately followed by one
+// pop, counting each pair as one op. Measures the uncontended cost of
+// the sequence-number protocol with no cache-line ping-pong.
+static void benchRingUncontended(uint64_t target_ns) {
+  MpmcTaskQueue ring(ThreadPool::DEFAULT_RING_CAPACITY);
+  auto [iterations, elapsed] = runTimed(target_ns, [&](uint64_t batch) {
+    for (uint64_t i = 0; i < batch; ++i) {
+      ring.push(PoolTask{static_cast<int>(i), TaskTag::HandleRequest});
+      PoolTask task;
+      ring.pop(task);
+      keep(task.fd);
+    }
+  });
+  report("ring_push_pop", 1, iterations, elapsed, 0);
+}
+
+// Contended ring throughput: `pairs` producers against `pairs`
+// consumers for the target duration. Reports completed transfers (a
+// push observed by a pop) per second.
+static void benchRingContended(int pairs, uint64_t target_ns) {
+  MpmcTaskQueue ring(ThreadPool::DEFAULT_RING_CAPACITY);
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> transferred{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < pairs; ++i) {
+    threads.emplace_back([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        ring.push(PoolTask{0, TaskTag::HandleRequest});
+      }
+    });
+    threads.emplace_back([&] {
+      uint64_t popped = 0;
+      PoolTask task;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (ring.pop(task))
+          ++popped;
+      }
+      transferred.fetch_add(popped, std::memory_order_relaxed);
+    });
+  }
+
+  uint64_t start = nowNanos();
+  std::this_thread::sleep_for(std::chrono::nanoseconds(target_ns));
+  stop = true;
+  for (std::thread &thread : threads)
+    thread.join();
+  uint64_t elapsed = nowNanos() - start;
+
+  char name[32];
+  snprintf(name, sizeof(name), "ring_contended");
+  report(name, pairs * 2, transferred.load(), elapsed, 0);
+}
+
+// Full dispatch round trip through the real ThreadPool: enqueueTask into
+// the ring, a worker pops it and runs the handler. Backpressure (a full
+// ring) pauses the producer rather than counting failed enqueues, so the
+// number reported is completed dispatches per second.
+static void benchPoolDispatch(size_t workers, uint64_t target_ns) {
+  std::atomic<uint64_t> handled{0};
+  ThreadPool pool(workers, [&](const PoolTask &) {
+    handled.fetch_add(1, std::memory_order_relaxed);
+  });
+
+  uint64_t start = nowNanos();
+  uint64_t enqueued = 0;
+  while (nowNanos() - start < target_ns) {
+    if (pool.enqueueTask(PoolTask{static_cast<int>(enqueued),
+                                  TaskTag::HandleRequest})) {
+      ++enqueued;
+    } else {
+      std::this_thread::yield(); // ring full - let the workers drain
+    }
+  }
+  // Drain so every enqueued task is counted before the pool dies.
+  while (handled.load(std::memory_order_relaxed) < enqueued)
+    std::this_thread::yield();
+  uint64_t elapsed = nowNanos() - start;
+
+  report("pool_dispatch", static_cast<int>(workers), enqueued, elapsed, 0);
+}
+
+static std::vector<int> parseThreadList(const char *spec) {
+  std::vector<int> counts;
+  std::stringstream stream(spec);
+  std::string token;
+  while (std::getline(stream, token, ',')) {
+    int value = atoi(token.c_str());
+    if (value > 0)
+      counts.push_back(value);
+  }
+  if (counts.empty())
+    counts = {1, 2, 4};
+  return counts;
+}
+
+} // namespace Microbench
+
+int main() {
+  using namespace Microbench;
+
+  uint64_t target_ns =
+      static_cast<uint64_t>(std::max(1, envInt("MICROBENCH_SECONDS", 1))) *
+      1'000'000'000ull;
+  std::vector<int> thread_counts =
+      parseThreadList(envString("MICROBENCH_THREADS", "1,2,4"));
+
+  fprintf(stderr, "🔬 Micro-benchmarks (%llu ms per benchmark)\n",
+          static_cast<unsigned long long>(target_ns / 1'000'000));
+
+  printf("benchmark,threads,iterations,ns_per_op,ops_per_sec,mb_per_sec\n");
+
+  benchScan("scan_ping", PING_REQUEST, sizeof(PING_REQUEST) - 1, target_ns);
+  benchScan("scan_browser", BROWSER_REQUEST, sizeof(BROWSER_REQUEST) - 1,
+            target_ns);
+  benchTimestampFormat(target_ns);
+  benchTimestampCached(target_ns);
+  benchRingUncontended(target_ns);
+  for (int pairs : thread_counts)
+    benchRingContended(pairs, target_ns);
+  for (int pairs : thread_counts)
+    benchPoolDispatch(static_cast<size_t>(pairs), target_ns);
+
+  fprintf(stderr, "✅ Done\n");
+  return 0;
+}